@@ -0,0 +1,21 @@
+#ifndef DETECT_H
+#define DETECT_H
+
+#include "language.h"
+
+// Bytes of a file inspected for detection
+#define DETECT_SAMPLE_SIZE 4096
+// Lines at the top of the sample searched for modelines
+#define DETECT_MODELINE_LINES 5
+// Time limit for scoring a sample, in microseconds
+#define DETECT_TIME_BUDGET_US 2000
+// Weighted keyword hits needed before a keyword guess is fully trusted
+#define DETECT_MIN_EVIDENCE 4.0
+// Guesses below this confidence are ignored by callers
+#define DETECT_MIN_CONFIDENCE 0.4
+
+// Function prototypes
+int detect_language(const char *sample, size_t len, Language *languages, int count, long budget_us, double *confidence);
+int detect_file_language(const char *path, Language *languages, int count, long budget_us, double *confidence);
+
+#endif
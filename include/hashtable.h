@@ -7,10 +7,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "intern.h"
 
 // Define hash table entry structure
 typedef struct Entry {
-    char *key;
+    const InternedString *key;  // owned by the intern pool
     struct Entry *next;
 } Entry;
 
@@ -20,6 +21,7 @@ typedef struct {
 } HashTable;
 
 // Function prototypes
+unsigned int hash_key(const char *key);
 unsigned int hash(const char *key);
 HashTable* create_table();
 void free_table(HashTable *table);
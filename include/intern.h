@@ -0,0 +1,21 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stddef.h>
+
+// Arena block size for interned strings
+#define INTERN_BLOCK_SIZE 16384
+
+// Immutable string shared by every table that holds the same key
+typedef struct {
+    unsigned int hash;  // full hash of str, precomputed once
+    unsigned int len;
+    char str[];
+} InternedString;
+
+// Function prototypes
+const InternedString* intern(const char *key);
+size_t intern_count();
+void intern_pool_free();
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef LANGUAGE_H
+#define LANGUAGE_H
+
+#include "hashtable.h"
+#include <stdbool.h>
+
+// Longest language name kept, e.g. "python" for python.yaml
+#define LANGUAGE_NAME_SIZE 32
+
+// Worker threads used to load syntax files at start-up
+#define LOAD_THREADS 4
+
+// Syntax tables loaded from one YAML file
+typedef struct {
+    const char *path;
+    char name[LANGUAGE_NAME_SIZE];  // file name without directory and extension
+    HashTable *keywords;
+    HashTable *singlecomments;
+    HashTable *multicomments1;
+    HashTable *multicomments2;
+    HashTable *strings;
+    HashTable *functions;
+    HashTable *symbols;
+    HashTable *operators;
+    int singlecommentslen;
+    bool loaded;
+    long load_us;       // time spent parsing this file
+} Language;
+
+// Defined in yaml-parser.c
+bool load_syntax(const char *path, HashTable *keywords, HashTable *singlecomments, HashTable *multicomments1, HashTable *multicomments2, HashTable *strings, HashTable *functions, HashTable *symbols, HashTable *operators, int *singlecommentslen);
+
+// Function prototypes
+Language* load_languages(const char **paths, int count, int threads);
+Language* language_by_name(Language *languages, int count, const char *name);
+void free_languages(Language *languages, int count);
+
+#endif
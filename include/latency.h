@@ -0,0 +1,40 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#define _POSIX_C_SOURCE 200809L
+
+// Four sub-buckets per power of two of microseconds, up to ~2^40us
+#define LATENCY_BUCKETS 160
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Limits for one highlighting pass, 0 means unlimited
+typedef struct {
+    long time_us;
+    size_t bytes;
+} HighlightBudget;
+
+// How far a budgeted highlighting pass got
+typedef struct {
+    size_t highlighted;   // bytes lexed and drawn with colours
+    int completed;        // 1 if the visible text was fully highlighted
+    int approximate;      // 1 if the string/comment state at the first line was guessed
+    long elapsed_us;
+} HighlightResult;
+
+// Define latency histogram structure
+typedef struct {
+    unsigned long counts[LATENCY_BUCKETS];
+    unsigned long total;
+} LatencyHistogram;
+
+// Function prototypes
+long latency_now_us();
+int budget_exhausted(const HighlightBudget *budget, size_t bytes, long start_us);
+void latency_init(LatencyHistogram *histogram);
+void latency_record(LatencyHistogram *histogram, long us);
+long latency_percentile(LatencyHistogram *histogram, double percentile);
+
+#endif
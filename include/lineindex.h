@@ -0,0 +1,49 @@
+#ifndef LINE_INDEX_H
+#define LINE_INDEX_H
+
+#include "stream.h"
+#include "latency.h"
+
+// Lines per absolute checkpoint, the rest are stored as varint deltas
+#define LINE_INDEX_STRIDE 64
+
+// Checkpoints lexed at most to recover the state at a line when no nearer one is cached
+#define LINE_INDEX_LOOKBACK 4
+
+// How the lexer state at a line was found
+typedef enum {
+    LINE_STATE_MISSING,       // the line is not indexed
+    LINE_STATE_EXACT,         // lexed from a checkpoint with a known state
+    LINE_STATE_APPROXIMATE    // guessed, no known state within reach or out of time
+} LineStateResult;
+
+// Absolute position of every LINE_INDEX_STRIDE-th line start
+typedef struct {
+    size_t offset;      // byte offset of the line start
+    size_t delta_pos;   // where the following deltas begin in the delta stream
+    StreamLineState line_state;  // lexer state at this line, once computed
+    int state_known;
+} LineCheckpoint;
+
+// Define line offset index structure
+typedef struct {
+    LineCheckpoint *checkpoints;
+    size_t checkpoint_count;
+    size_t checkpoint_cap;
+    unsigned char *deltas;      // varint-encoded gaps between line starts
+    size_t delta_len;
+    size_t delta_cap;
+    size_t line_count;
+    size_t last_start;          // offset of the most recent line start
+    size_t length;              // bytes indexed so far
+} LineIndex;
+
+// Function prototypes
+LineIndex* line_index_create();
+void line_index_free(LineIndex *index);
+void line_index_reset(LineIndex *index);
+void line_index_append(LineIndex *index, const char *data, size_t len);
+int line_index_offset(LineIndex *index, size_t line, size_t *offset);
+LineStateResult line_index_state(LineIndex *index, const char *data, size_t line, StreamLexer *lexer, const HighlightBudget *budget, long start_us, StreamLineState *line_state);
+
+#endif
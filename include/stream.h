@@ -0,0 +1,65 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "hashtable.h"
+
+#define STREAM_WORD_SIZE 256
+#define STREAM_PENDING_SIZE 8
+
+// Colour pair used for text that is not highlighted
+#define STREAM_PLAIN 0
+
+// Lexer states that can still be open when a chunk ends
+typedef enum {
+    STREAM_NORMAL,
+    STREAM_STRING,
+    STREAM_LINE_COMMENT,
+    STREAM_BLOCK_COMMENT
+} StreamState;
+
+// Lexer state that can still be open at the start of a line
+typedef struct {
+    StreamState state;
+    char string_delim;
+    char string_escape;
+    char block_close_pending;
+} StreamLineState;
+
+// Called once per finished span; text is only valid during the call
+typedef void (*span_callback)(const char *text, size_t len, int color_pair, void *userdata);
+
+// Streaming tokenizer state, carried across chunk boundaries
+typedef struct {
+    HashTable *keywords;
+    HashTable *singlecomments;
+    HashTable *multicomments1;
+    HashTable *multicomments2;
+    HashTable *strings;
+    HashTable *functions;
+    HashTable *symbols;
+    HashTable *operators;
+    int singlecommentslen;
+
+    span_callback emit;
+    void *userdata;
+
+    StreamState state;
+    char string_delim;          // delimiter that opened the current string
+    int string_escape;          // previous string char was a backslash
+    int block_close_pending;    // last block comment char may start its terminator
+    char pending[STREAM_PENDING_SIZE]; // possible comment opener awaiting more input
+    int pending_len;
+    char word[STREAM_WORD_SIZE];  // partial identifier
+    int word_len;
+    int word_after_dot;         // partial identifier follows a '.'
+    size_t offset;              // bytes consumed so far
+} StreamLexer;
+
+// Function prototypes
+void stream_init(StreamLexer *lexer, HashTable *keywords, HashTable *singlecomments, HashTable *multicomments1, HashTable *multicomments2, HashTable *strings, HashTable *functions, HashTable *symbols, HashTable *operators, int singlecommentslen, span_callback emit, void *userdata);
+void stream_feed(StreamLexer *lexer, const char *chunk, size_t len);
+void stream_finish(StreamLexer *lexer);
+void stream_save_line_state(const StreamLexer *lexer, StreamLineState *line_state);
+void stream_restore_line_state(StreamLexer *lexer, const StreamLineState *line_state);
+
+#endif
@@ -0,0 +1,265 @@
+#include "../include/detect.h"
+#include "../include/latency.h"
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Find a loaded language by name, ignoring case and the given length of name
+static int find_language(const char *name, size_t len, Language *languages, int count) {
+    for (int i = 0; i < count; ++i) {
+        if (!languages[i].loaded || strlen(languages[i].name) != len) {
+            continue;
+        }
+        size_t j = 0;
+        while (j < len && tolower((unsigned char)name[j]) == tolower((unsigned char)languages[i].name[j])) {
+            j++;
+        }
+        if (j == len) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Length of the word at text (letters, digits, '_', '+', '-')
+static size_t word_length(const char *text, const char *end) {
+    const char *cursor = text;
+    while (cursor < end && (isalnum((unsigned char)*cursor) || *cursor == '_' || *cursor == '+' || *cursor == '-')) {
+        cursor++;
+    }
+    return cursor - text;
+}
+
+// Check if a line contains the given text
+static int line_contains(const char *line, const char *line_end, const char *needle) {
+    size_t needle_len = strlen(needle);
+    for (; (size_t)(line_end - line) >= needle_len; ++line) {
+        if (strncmp(line, needle, needle_len) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Check for a Vim modeline marker, which must start the line or follow whitespace
+static int has_vim_marker(const char *line, const char *line_end) {
+    static const char *const markers[] = { "vim:", "vi:", "ex:" };
+
+    for (const char *cursor = line; cursor < line_end; ++cursor) {
+        if (cursor > line && !isspace((unsigned char)cursor[-1])) {
+            continue;
+        }
+        for (size_t m = 0; m < sizeof(markers) / sizeof(markers[0]); ++m) {
+            size_t marker_len = strlen(markers[m]);
+            if ((size_t)(line_end - cursor) >= marker_len && strncmp(cursor, markers[m], marker_len) == 0) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+// "#!/usr/bin/env python3" or "#!/usr/bin/python3.11" names the interpreter
+static int detect_shebang(const char *sample, const char *line_end, Language *languages, int count) {
+    const char *cursor = sample + 2;
+
+    while (cursor < line_end && isspace((unsigned char)*cursor)) {
+        cursor++;
+    }
+
+    // Interpreter basename
+    const char *name = cursor;
+    while (cursor < line_end && !isspace((unsigned char)*cursor)) {
+        if (*cursor == '/') {
+            name = cursor + 1;
+        }
+        cursor++;
+    }
+    size_t len = cursor - name;
+
+    // With env the interpreter is the first argument that is not an option
+    if (len == 3 && strncmp(name, "env", 3) == 0) {
+        for (;;) {
+            while (cursor < line_end && isspace((unsigned char)*cursor)) {
+                cursor++;
+            }
+            name = cursor;
+            while (cursor < line_end && !isspace((unsigned char)*cursor)) {
+                cursor++;
+            }
+            len = cursor - name;
+            if (len == 0 || *name != '-') {
+                break;
+            }
+        }
+    }
+
+    // Drop version suffixes such as "3" or "3.11"
+    while (len > 0 && (isdigit((unsigned char)name[len - 1]) || name[len - 1] == '.')) {
+        len--;
+    }
+
+    return len > 0 ? find_language(name, len, languages, count) : -1;
+}
+
+// Vim "vim: set ft=python:" / "filetype=" / "syntax=" and Emacs "-*- mode: c -*-" modelines
+static int detect_modeline(const char *line, const char *line_end, Language *languages, int count) {
+    static const char *const keys[] = { "filetype=", "ft=", "syntax=", "mode:" };
+
+    // Only lines marked as modelines are considered
+    if (!has_vim_marker(line, line_end) && !line_contains(line, line_end, "-*-")) {
+        return -1;
+    }
+
+    for (const char *cursor = line; cursor < line_end; ++cursor) {
+        for (size_t k = 0; k < sizeof(keys) / sizeof(keys[0]); ++k) {
+            size_t key_len = strlen(keys[k]);
+            if ((size_t)(line_end - cursor) < key_len || strncmp(cursor, keys[k], key_len) != 0) {
+                continue;
+            }
+            // Require a word boundary so e.g. "draft=" is not read as "ft="
+            if (cursor > line && (isalnum((unsigned char)cursor[-1]) || cursor[-1] == '_')) {
+                continue;
+            }
+            const char *value = cursor + key_len;
+            while (value < line_end && *value == ' ') {
+                value++;
+            }
+            int found = find_language(value, word_length(value, line_end), languages, count);
+            if (found >= 0) {
+                return found;
+            }
+        }
+    }
+
+    // Emacs short form: "-*- python -*-"
+    const char *open = line;
+    while ((open = memchr(open, '-', line_end - open)) != NULL && line_end - open > 3) {
+        if (open[1] == '*' && open[2] == '-') {
+            const char *value = open + 3;
+            while (value < line_end && *value == ' ') {
+                value++;
+            }
+            int found = find_language(value, word_length(value, line_end), languages, count);
+            if (found >= 0) {
+                return found;
+            }
+        }
+        open++;
+    }
+
+    return -1;
+}
+
+// Guess the language of a sample: shebang, then modelines, then keyword frequency
+int detect_language(const char *sample, size_t len, Language *languages, int count, long budget_us, double *confidence) {
+    const char *end = sample + len;
+    const char *line = sample;
+    int found;
+
+    *confidence = 0.0;
+    if (len == 0 || count <= 0) {
+        return -1;
+    }
+
+    // Shebang and modelines are explicit, so they are trusted fully
+    for (int n = 0; n < DETECT_MODELINE_LINES && line < end; ++n) {
+        const char *line_end = memchr(line, '\n', end - line);
+        if (line_end == NULL) {
+            line_end = end;
+        }
+        if (n == 0 && line_end - line > 2 && line[0] == '#' && line[1] == '!') {
+            found = detect_shebang(line, line_end, languages, count);
+        } else {
+            found = detect_modeline(line, line_end, languages, count);
+        }
+        if (found >= 0) {
+            *confidence = 1.0;
+            return found;
+        }
+        line = line_end + 1;
+    }
+
+    // One pass over the identifiers, scored against every keywords table
+    double *scores = (double *)calloc(count, sizeof(double));
+    int *hits = (int *)malloc(count * sizeof(int));
+    char word[64];
+    double total = 0.0;
+    long start_us = latency_now_us();
+    unsigned int words = 0;
+    const char *cursor = sample;
+
+    while (cursor < end) {
+        // Identifiers, optionally with a directive '#' prefix such as "#include"
+        const char *word_start = cursor;
+        if (*cursor == '#' && cursor + 1 < end && (isalpha((unsigned char)cursor[1]) || cursor[1] == '_')) {
+            cursor++;
+        } else if (!(isalpha((unsigned char)*cursor) || *cursor == '_')) {
+            cursor++;
+            continue;
+        }
+        while (cursor < end && (isalnum((unsigned char)*cursor) || *cursor == '_')) {
+            cursor++;
+        }
+
+        size_t word_len = cursor - word_start;
+        if (word_len >= sizeof(word)) {
+            continue;
+        }
+        memcpy(word, word_start, word_len);
+        word[word_len] = '\0';
+
+        // Keywords shared by many languages say little, so split the weight
+        int matches = 0;
+        for (int i = 0; i < count; ++i) {
+            hits[i] = languages[i].loaded && search(languages[i].keywords, word);
+            matches += hits[i];
+        }
+        if (matches > 0) {
+            for (int i = 0; i < count; ++i) {
+                if (hits[i]) {
+                    scores[i] += 1.0 / matches;
+                }
+            }
+            total += 1.0;
+        }
+
+        // Stay within the time budget, checking the clock every 64 words
+        if (++words % 64 == 0 && budget_us > 0 && latency_now_us() - start_us >= budget_us) {
+            break;
+        }
+    }
+
+    found = -1;
+    for (int i = 0; i < count; ++i) {
+        if (scores[i] > 0.0 && (found < 0 || scores[i] > scores[found])) {
+            found = i;
+        }
+    }
+
+    // Share of the evidence won by the best language, discounted for small samples
+    if (found >= 0) {
+        double evidence = total < DETECT_MIN_EVIDENCE ? total / DETECT_MIN_EVIDENCE : 1.0;
+        *confidence = scores[found] / total * evidence;
+    }
+
+    free(scores);
+    free(hits);
+    return found;
+}
+
+// Read the first DETECT_SAMPLE_SIZE bytes of a file and detect its language
+int detect_file_language(const char *path, Language *languages, int count, long budget_us, double *confidence) {
+    char sample[DETECT_SAMPLE_SIZE];
+    int fd = open(path, O_RDONLY);
+    ssize_t len;
+
+    *confidence = 0.0;
+    if (fd < 0) {
+        return -1;
+    }
+    len = read(fd, sample, sizeof(sample));
+    close(fd);
+
+    return len > 0 ? detect_language(sample, (size_t)len, languages, count, budget_us, confidence) : -1;
+}
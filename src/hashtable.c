@@ -1,20 +1,21 @@
 #include "../include/hashtable.h"
 
-// Hash function
-unsigned int hash(const char *key) {
-    unsigned long int value = 0;
-    unsigned int i = 0;
-    unsigned int key_len = strlen(key);
+// Full hash of a key, stored alongside interned keys
+unsigned int hash_key(const char *key) {
+    unsigned int value = 0;
 
-    for (; i < key_len; ++i) {
-        value = value * 37 + key[i];
+    for (; *key != '\0'; ++key) {
+        value = value * 37 + (unsigned char)*key;
     }
 
-    value = value % TABLE_SIZE;
-
     return value;
 }
 
+// Hash function
+unsigned int hash(const char *key) {
+    return hash_key(key) % TABLE_SIZE;
+}
+
 // Create a new hash table
 HashTable* create_table() {
     HashTable *table = (HashTable *)malloc(sizeof(HashTable));
@@ -33,7 +34,6 @@ void free_table(HashTable *table) {
         while (entry != NULL) {
             Entry *temp = entry;
             entry = entry->next;
-            free(temp->key);
             free(temp);
         }
     }
@@ -42,29 +42,33 @@ void free_table(HashTable *table) {
 
 // Insert a key into the hash table
 void insert(HashTable *table, const char *key) {
-    unsigned int slot = hash(key);
+    const InternedString *interned = intern(key);
+    unsigned int slot = interned->hash % TABLE_SIZE;
 
+    // Interned keys are unique, so pointer equality is enough
     Entry *entry = table->entries[slot];
     while (entry != NULL) {
-        if (strcmp(entry->key, key) == 0) {
+        if (entry->key == interned) {
             return;
         }
         entry = entry->next;
     }
 
     Entry *new_entry = (Entry *)malloc(sizeof(Entry));
-    new_entry->key = strdup(key);
+    new_entry->key = interned;
     new_entry->next = table->entries[slot];
     table->entries[slot] = new_entry;
 }
 
 // Search for a key in the hash table
 int search(HashTable *table, const char *key) {
-    unsigned int slot = hash(key);
+    unsigned int key_hash = hash_key(key);
+    unsigned int slot = key_hash % TABLE_SIZE;
 
+    // Stored hashes rule out most collisions without a strcmp
     Entry *entry = table->entries[slot];
     while (entry != NULL) {
-        if (strcmp(entry->key, key) == 0) {
+        if (entry->key->hash == key_hash && strcmp(entry->key->str, key) == 0) {
             return 1;
         }
         entry = entry->next;
@@ -75,12 +79,11 @@ int search(HashTable *table, const char *key) {
 
 // Check if hash table contains a character key
 int hash_table_contains(HashTable *table, const char *key) {
-    char key_str[2] = {*key, '\0'};
-    unsigned int slot = hash(key_str);
-    Entry *entry = table->entries[slot];
+    unsigned int key_hash = (unsigned char)*key;
+    Entry *entry = table->entries[key_hash % TABLE_SIZE];
 
     while (entry != NULL) {
-        if (strcmp(entry->key, key_str) == 0) {
+        if (entry->key->hash == key_hash && entry->key->len == 1) {
             return 1;
         }
         entry = entry->next;
@@ -93,7 +96,7 @@ void print_table(HashTable *table) {
         Entry *entry = table->entries[i];
         if (entry != NULL) {
             while (entry != NULL) {
-                printf("  %s\n", entry->key);
+                printf("  %s\n", entry->key->str);
                 entry = entry->next;
             }
         }
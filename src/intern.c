@@ -0,0 +1,121 @@
+#include "../include/hashtable.h"
+#include <pthread.h>
+
+// Arena block, interned strings never move once allocated
+typedef struct InternBlock {
+    struct InternBlock *next;
+    size_t used;
+    size_t size;
+    char data[];
+} InternBlock;
+
+// Global pool: arena for the strings plus an open addressing set for dedupe
+static InternBlock *blocks = NULL;
+static const InternedString **slots = NULL;
+static size_t slot_cap = 0;
+static size_t slot_count = 0;
+
+// Syntax files may be loaded on several threads at once
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *pool_alloc(size_t size) {
+    // Keep every string aligned for its header
+    size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+    if (blocks == NULL || blocks->size - blocks->used < size) {
+        size_t block_size = size > INTERN_BLOCK_SIZE ? size : INTERN_BLOCK_SIZE;
+        InternBlock *block = (InternBlock *)malloc(sizeof(InternBlock) + block_size);
+        if (block == NULL) {
+            fprintf(stderr, " [INTERN] Out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+        block->next = blocks;
+        block->used = 0;
+        block->size = block_size;
+        blocks = block;
+    }
+
+    void *ptr = blocks->data + blocks->used;
+    blocks->used += size;
+    return ptr;
+}
+
+// Double the dedupe set, rehashing with the stored hashes
+static void grow_slots() {
+    size_t new_cap = slot_cap ? slot_cap * 2 : 256;
+    const InternedString **new_slots = (const InternedString **)calloc(new_cap, sizeof(InternedString *));
+    if (new_slots == NULL) {
+        fprintf(stderr, " [INTERN] Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (size_t i = 0; i < slot_cap; ++i) {
+        if (slots[i] != NULL) {
+            size_t j = slots[i]->hash & (new_cap - 1);
+            while (new_slots[j] != NULL) {
+                j = (j + 1) & (new_cap - 1);
+            }
+            new_slots[j] = slots[i];
+        }
+    }
+
+    free(slots);
+    slots = new_slots;
+    slot_cap = new_cap;
+}
+
+// Return the shared copy of a key, adding it to the pool on first use
+const InternedString* intern(const char *key) {
+    unsigned int key_hash = hash_key(key);
+    size_t len = strlen(key);
+    const InternedString *found = NULL;
+
+    pthread_mutex_lock(&pool_lock);
+    if (slot_count * 2 >= slot_cap) {
+        grow_slots();
+    }
+
+    size_t i = key_hash & (slot_cap - 1);
+    while (slots[i] != NULL) {
+        if (slots[i]->hash == key_hash && slots[i]->len == len && memcmp(slots[i]->str, key, len) == 0) {
+            found = slots[i];
+            break;
+        }
+        i = (i + 1) & (slot_cap - 1);
+    }
+
+    if (found == NULL) {
+        InternedString *interned = (InternedString *)pool_alloc(sizeof(InternedString) + len + 1);
+        interned->hash = key_hash;
+        interned->len = (unsigned int)len;
+        memcpy(interned->str, key, len + 1);
+
+        slots[i] = interned;
+        slot_count++;
+        found = interned;
+    }
+    pthread_mutex_unlock(&pool_lock);
+
+    return found;
+}
+
+// Number of distinct strings in the pool
+size_t intern_count() {
+    pthread_mutex_lock(&pool_lock);
+    size_t count = slot_count;
+    pthread_mutex_unlock(&pool_lock);
+    return count;
+}
+
+// Free the pool, only valid once no table references it
+void intern_pool_free() {
+    while (blocks != NULL) {
+        InternBlock *next = blocks->next;
+        free(blocks);
+        blocks = next;
+    }
+    free(slots);
+    slots = NULL;
+    slot_cap = 0;
+    slot_count = 0;
+}
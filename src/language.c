@@ -0,0 +1,127 @@
+#include "../include/language.h"
+#include "../include/latency.h"
+#include <pthread.h>
+
+// Work shared by the loader threads
+typedef struct {
+    Language *languages;
+    int count;
+    int next;
+    pthread_mutex_t lock;
+} LoadQueue;
+
+// Derive the language name from its syntax file path
+static void set_name(Language *language) {
+    const char *base = strrchr(language->path, '/');
+    base = base ? base + 1 : language->path;
+
+    const char *dot = strrchr(base, '.');
+    size_t len = dot && dot != base ? (size_t)(dot - base) : strlen(base);
+    if (len >= LANGUAGE_NAME_SIZE) {
+        len = LANGUAGE_NAME_SIZE - 1;
+    }
+    memcpy(language->name, base, len);
+    language->name[len] = '\0';
+}
+
+// Parse one syntax file into its own tables
+static void load_language(Language *language) {
+    long start_us = latency_now_us();
+
+    language->keywords = create_table();
+    language->singlecomments = create_table();
+    language->multicomments1 = create_table();
+    language->multicomments2 = create_table();
+    language->strings = create_table();
+    language->functions = create_table();
+    language->symbols = create_table();
+    language->operators = create_table();
+    language->singlecommentslen = 0;
+    language->loaded = load_syntax(language->path, language->keywords, language->singlecomments, language->multicomments1, language->multicomments2, language->strings, language->functions, language->symbols, language->operators, &language->singlecommentslen);
+
+    language->load_us = latency_now_us() - start_us;
+}
+
+// Worker loop: take the next unloaded file until none are left
+static void *load_worker(void *arg) {
+    LoadQueue *queue = (LoadQueue *)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&queue->lock);
+        int index = queue->next++;
+        pthread_mutex_unlock(&queue->lock);
+
+        if (index >= queue->count) {
+            break;
+        }
+        load_language(&queue->languages[index]);
+    }
+
+    return NULL;
+}
+
+// Load all syntax files concurrently, the array is only returned once every file is done
+Language* load_languages(const char **paths, int count, int threads) {
+    Language *languages = (Language *)calloc(count, sizeof(Language));
+    pthread_t workers[LOAD_THREADS];
+    LoadQueue queue;
+    int started = 0;
+
+    for (int i = 0; i < count; ++i) {
+        languages[i].path = paths[i];
+        set_name(&languages[i]);
+    }
+
+    queue.languages = languages;
+    queue.count = count;
+    queue.next = 0;
+    pthread_mutex_init(&queue.lock, NULL);
+
+    if (threads > LOAD_THREADS) {
+        threads = LOAD_THREADS;
+    }
+    if (threads > count) {
+        threads = count;
+    }
+    for (; started < threads; ++started) {
+        if (pthread_create(&workers[started], NULL, load_worker, &queue) != 0) {
+            break;
+        }
+    }
+
+    // Fall back to loading on this thread if no worker could be started
+    if (started == 0) {
+        load_worker(&queue);
+    }
+    for (int i = 0; i < started; ++i) {
+        pthread_join(workers[i], NULL);
+    }
+
+    pthread_mutex_destroy(&queue.lock);
+    return languages;
+}
+
+// Find a language by name, e.g. "java", returns NULL if it is not configured
+Language* language_by_name(Language *languages, int count, const char *name) {
+    for (int i = 0; i < count; ++i) {
+        if (strcmp(languages[i].name, name) == 0) {
+            return &languages[i];
+        }
+    }
+    return NULL;
+}
+
+// Free every table of every language
+void free_languages(Language *languages, int count) {
+    for (int i = 0; i < count; ++i) {
+        free_table(languages[i].keywords);
+        free_table(languages[i].singlecomments);
+        free_table(languages[i].multicomments1);
+        free_table(languages[i].multicomments2);
+        free_table(languages[i].strings);
+        free_table(languages[i].functions);
+        free_table(languages[i].symbols);
+        free_table(languages[i].operators);
+    }
+    free(languages);
+}
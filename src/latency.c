@@ -0,0 +1,79 @@
+#include "../include/latency.h"
+#include <time.h>
+
+// Monotonic clock in microseconds
+long latency_now_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long)ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+// Check if either limit of the budget has been used up
+int budget_exhausted(const HighlightBudget *budget, size_t bytes, long start_us) {
+    if (budget == NULL) {
+        return 0;
+    }
+    if (budget->bytes > 0 && bytes >= budget->bytes) {
+        return 1;
+    }
+    if (budget->time_us > 0 && latency_now_us() - start_us >= budget->time_us) {
+        return 1;
+    }
+    return 0;
+}
+
+// Map a sample to its bucket: exact below 4us, then 4 buckets per power of two
+static int bucket_index(unsigned long us) {
+    int msb = 0;
+    int index;
+
+    if (us < 4) {
+        return (int)us;
+    }
+    while ((us >> (msb + 1)) != 0) {
+        msb++;
+    }
+    index = 4 * (msb - 1) + (int)((us >> (msb - 2)) & 3);
+    return index < LATENCY_BUCKETS ? index : LATENCY_BUCKETS - 1;
+}
+
+// Largest value that falls into a bucket
+static long bucket_upper(int index) {
+    if (index < 4) {
+        return index;
+    }
+    int msb = index / 4 + 1;
+    long width = 1L << (msb - 2);
+    return (4 + index % 4) * width + width - 1;
+}
+
+void latency_init(LatencyHistogram *histogram) {
+    memset(histogram, 0, sizeof(*histogram));
+}
+
+// Record one latency sample in microseconds
+void latency_record(LatencyHistogram *histogram, long us) {
+    histogram->counts[bucket_index(us > 0 ? (unsigned long)us : 0)]++;
+    histogram->total++;
+}
+
+// Upper bound of the bucket holding the given percentile (0-100), -1 if empty
+long latency_percentile(LatencyHistogram *histogram, double percentile) {
+    if (histogram->total == 0) {
+        return -1;
+    }
+
+    unsigned long rank = (unsigned long)(histogram->total * percentile / 100.0 + 0.5);
+    unsigned long seen = 0;
+
+    if (rank == 0) {
+        rank = 1;
+    }
+    for (int i = 0; i < LATENCY_BUCKETS; ++i) {
+        seen += histogram->counts[i];
+        if (seen >= rank) {
+            return bucket_upper(i);
+        }
+    }
+    return bucket_upper(LATENCY_BUCKETS - 1);
+}
@@ -0,0 +1,159 @@
+#include "../include/lineindex.h"
+
+// Grow a buffer to hold at least `needed` elements of `size` bytes
+static void *grow(void *buffer, size_t *cap, size_t needed, size_t size) {
+    if (needed <= *cap) {
+        return buffer;
+    }
+    size_t new_cap = *cap ? *cap * 2 : 64;
+    while (new_cap < needed) {
+        new_cap *= 2;
+    }
+    buffer = realloc(buffer, new_cap * size);
+    if (buffer == NULL) {
+        fprintf(stderr, " [LINEINDEX] Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    *cap = new_cap;
+    return buffer;
+}
+
+// Record the start of a new line at the given offset
+static void add_line_start(LineIndex *index, size_t offset) {
+    if (index->line_count % LINE_INDEX_STRIDE == 0) {
+        index->checkpoints = grow(index->checkpoints, &index->checkpoint_cap, index->checkpoint_count + 1, sizeof(LineCheckpoint));
+        index->checkpoints[index->checkpoint_count].offset = offset;
+        index->checkpoints[index->checkpoint_count].delta_pos = index->delta_len;
+        index->checkpoints[index->checkpoint_count].state_known = 0;
+        index->checkpoint_count++;
+    } else {
+        // LEB128 style varint: 7 bits per byte, high bit marks continuation
+        size_t delta = offset - index->last_start;
+        index->deltas = grow(index->deltas, &index->delta_cap, index->delta_len + sizeof(size_t) + 2, 1);
+        while (delta >= 0x80) {
+            index->deltas[index->delta_len++] = (unsigned char)(delta | 0x80);
+            delta >>= 7;
+        }
+        index->deltas[index->delta_len++] = (unsigned char)delta;
+    }
+    index->last_start = offset;
+    index->line_count++;
+}
+
+// State outside of any string or comment
+static void normal_state(StreamLineState *line_state) {
+    memset(line_state, 0, sizeof(StreamLineState));
+    line_state->state = STREAM_NORMAL;
+}
+
+// Create a new, empty line index (line 0 starts at offset 0)
+LineIndex* line_index_create() {
+    LineIndex *index = (LineIndex *)calloc(1, sizeof(LineIndex));
+    line_index_reset(index);
+    return index;
+}
+
+// Forget every indexed line, e.g. when the file was truncated
+void line_index_reset(LineIndex *index) {
+    index->checkpoint_count = 0;
+    index->delta_len = 0;
+    index->line_count = 0;
+    index->last_start = 0;
+    index->length = 0;
+    add_line_start(index, 0);
+
+    // The text starts outside of any string or comment
+    normal_state(&index->checkpoints[0].line_state);
+    index->checkpoints[0].state_known = 1;
+}
+
+// Free the line index
+void line_index_free(LineIndex *index) {
+    free(index->checkpoints);
+    free(index->deltas);
+    free(index);
+}
+
+// Index bytes appended to the end of the text, can be called as the file grows
+void line_index_append(LineIndex *index, const char *data, size_t len) {
+    const char *cursor = data;
+    const char *end = data + len;
+
+    // memchr is vectorized in libc, so this is a single SIMD pass over the data
+    while ((cursor = memchr(cursor, '\n', end - cursor)) != NULL) {
+        cursor++;
+        add_line_start(index, index->length + (cursor - data));
+    }
+
+    index->length += len;
+}
+
+// Look up the byte offset of a 0-based line, returns 0 if the line is not indexed
+int line_index_offset(LineIndex *index, size_t line, size_t *offset) {
+    if (line >= index->line_count) {
+        return 0;
+    }
+
+    LineCheckpoint *checkpoint = &index->checkpoints[line / LINE_INDEX_STRIDE];
+    const unsigned char *delta = index->deltas + checkpoint->delta_pos;
+    size_t position = checkpoint->offset;
+
+    for (size_t i = 0; i < line % LINE_INDEX_STRIDE; ++i) {
+        size_t gap = 0;
+        int shift = 0;
+        do {
+            gap |= (size_t)(*delta & 0x7f) << shift;
+            shift += 7;
+        } while (*delta++ & 0x80);
+        position += gap;
+    }
+
+    *offset = position;
+    return 1;
+}
+
+// Find the lexer state at the start of a 0-based line. The lexer (tables plus a callback
+// that ignores spans) is run forward from the nearest checkpoint with a known state, at most
+// LINE_INDEX_LOOKBACK checkpoints back, and every checkpoint passed on the way is cached.
+// Without a known state in reach the look-back starts outside any string or comment and
+// the result is approximate (and not cached). Running out of time falls back to that state
+// at the line itself. Only the time limit of the budget applies, its byte limit is for drawing.
+LineStateResult line_index_state(LineIndex *index, const char *data, size_t line, StreamLexer *lexer, const HighlightBudget *budget, long start_us, StreamLineState *line_state) {
+    size_t offset;
+
+    if (!line_index_offset(index, line, &offset)) {
+        return LINE_STATE_MISSING;
+    }
+
+    size_t target = line / LINE_INDEX_STRIDE;
+    size_t first = target > LINE_INDEX_LOOKBACK ? target - LINE_INDEX_LOOKBACK : 0;
+    size_t known = target;
+    while (known > first && !index->checkpoints[known].state_known) {
+        known--;
+    }
+
+    int exact = index->checkpoints[known].state_known;
+    if (exact) {
+        stream_restore_line_state(lexer, &index->checkpoints[known].line_state);
+    } else {
+        normal_state(line_state);
+        stream_restore_line_state(lexer, line_state);
+    }
+
+    for (size_t i = known; i < target; ++i) {
+        if (budget_exhausted(budget, 0, start_us)) {
+            normal_state(line_state);
+            return LINE_STATE_APPROXIMATE;
+        }
+        LineCheckpoint *next = &index->checkpoints[i + 1];
+        stream_feed(lexer, data + index->checkpoints[i].offset, next->offset - index->checkpoints[i].offset);
+        if (exact) {
+            stream_save_line_state(lexer, &next->line_state);
+            next->state_known = 1;
+        }
+    }
+
+    stream_feed(lexer, data + index->checkpoints[target].offset, offset - index->checkpoints[target].offset);
+    stream_save_line_state(lexer, line_state);
+    return exact ? LINE_STATE_EXACT : LINE_STATE_APPROXIMATE;
+}
@@ -0,0 +1,253 @@
+#include "../include/stream.h"
+#include <ctype.h>
+
+static void process_char(StreamLexer *lexer, char c, int allow_comment);
+
+// Check if a single character is present in a table
+static int contains_char(HashTable *table, char c) {
+    return hash_table_contains(table, &c);
+}
+
+static void emit_span(StreamLexer *lexer, const char *text, size_t len, int color_pair) {
+    if (len > 0) {
+        lexer->emit(text, len, color_pair, lexer->userdata);
+    }
+}
+
+// Colour a completed identifier the same way highlight_code does at a word boundary
+static int classify_word(StreamLexer *lexer) {
+    if (lexer->word_after_dot) {
+        return search(lexer->functions, lexer->word) ? 26 : STREAM_PLAIN;
+    }
+    if (search(lexer->keywords, lexer->word)) {
+        return 24;
+    } else if (search(lexer->functions, lexer->word)) {
+        return 26;
+    } else if (search(lexer->symbols, lexer->word)) {
+        return 25;
+    }
+    return STREAM_PLAIN;
+}
+
+// Emit the partial identifier; a negative color_pair means classify it
+static void flush_word(StreamLexer *lexer, int color_pair) {
+    if (lexer->word_len == 0) {
+        lexer->word_after_dot = 0;
+        return;
+    }
+    lexer->word[lexer->word_len] = '\0';
+    if (color_pair < 0 || lexer->word_after_dot) {
+        color_pair = classify_word(lexer);
+    }
+    emit_span(lexer, lexer->word, lexer->word_len, color_pair);
+    lexer->word_len = 0;
+    lexer->word_after_dot = 0;
+}
+
+static void push_word(StreamLexer *lexer, char c) {
+    // Keep the working buffer bounded: overlong identifiers are split
+    if (lexer->word_len == STREAM_WORD_SIZE - 1) {
+        flush_word(lexer, -1);
+    }
+    lexer->word[lexer->word_len++] = c;
+}
+
+// Replay characters held back while waiting to see if they open a comment
+static void replay_pending(StreamLexer *lexer, char c, int with_c) {
+    char held[STREAM_PENDING_SIZE + 1];
+    int held_len = lexer->pending_len;
+
+    memcpy(held, lexer->pending, held_len);
+    if (with_c) {
+        held[held_len++] = c;
+    }
+    lexer->pending_len = 0;
+
+    // The first held character is known not to open a comment
+    process_char(lexer, held[0], 0);
+    for (int i = 1; i < held_len; ++i) {
+        process_char(lexer, held[i], 1);
+    }
+}
+
+// Advance an open string or comment by c, returns 0 if c ends the run unconsumed
+static int step_inside(StreamLexer *lexer, char c) {
+    switch (lexer->state) {
+        case STREAM_LINE_COMMENT:
+            if (c == '\n') {
+                lexer->state = STREAM_NORMAL;
+                return 0;
+            }
+            return 1;
+        case STREAM_STRING:
+            if (lexer->string_escape) {
+                lexer->string_escape = 0;
+            } else if (c == '\\') {
+                lexer->string_escape = 1;
+            } else if (c == lexer->string_delim) {
+                lexer->state = STREAM_NORMAL;
+            }
+            return 1;
+        case STREAM_BLOCK_COMMENT:
+            if (lexer->block_close_pending && contains_char(lexer->multicomments1, c)) {
+                lexer->state = STREAM_NORMAL;
+                lexer->block_close_pending = 0;
+            } else {
+                lexer->block_close_pending = contains_char(lexer->multicomments2, c);
+            }
+            return 1;
+        case STREAM_NORMAL:
+            break;
+    }
+    return 0;
+}
+
+// Decide what a held comment prefix becomes now that c has arrived
+static void resolve_pending(StreamLexer *lexer, char c) {
+    if (lexer->pending_len == 1 && contains_char(lexer->multicomments1, lexer->pending[0]) && contains_char(lexer->multicomments2, c)) {
+        lexer->pending[lexer->pending_len++] = c;
+        flush_word(lexer, STREAM_PLAIN);
+        emit_span(lexer, lexer->pending, lexer->pending_len, 21);
+        lexer->pending_len = 0;
+        lexer->state = STREAM_BLOCK_COMMENT;
+        lexer->block_close_pending = 0;
+    } else if (contains_char(lexer->singlecomments, lexer->pending[0]) && contains_char(lexer->singlecomments, c) && lexer->pending_len < lexer->singlecommentslen) {
+        lexer->pending[lexer->pending_len++] = c;
+        if (lexer->pending_len == lexer->singlecommentslen) {
+            flush_word(lexer, STREAM_PLAIN);
+            emit_span(lexer, lexer->pending, lexer->pending_len, 21);
+            lexer->pending_len = 0;
+            lexer->state = STREAM_LINE_COMMENT;
+        }
+    } else {
+        replay_pending(lexer, c, 1);
+    }
+}
+
+// Advance the lexer by a single character
+static void process_char(StreamLexer *lexer, char c, int allow_comment) {
+    if (lexer->pending_len > 0) {
+        resolve_pending(lexer, c);
+        return;
+    }
+
+    if (lexer->state != STREAM_NORMAL) {
+        int color_pair = lexer->state == STREAM_STRING ? 22 : 21;
+        if (step_inside(lexer, c)) {
+            emit_span(lexer, &c, 1, color_pair);
+            return;
+        }
+    }
+
+    // A member name after '.' ends at the first non identifier character
+    if (lexer->word_after_dot && !(isalnum((unsigned char)c) || c == '_')) {
+        flush_word(lexer, -1);
+    }
+
+    if (allow_comment && lexer->singlecommentslen == 1 && contains_char(lexer->singlecomments, c)) {
+        flush_word(lexer, STREAM_PLAIN);
+        emit_span(lexer, &c, 1, 21);
+        lexer->state = STREAM_LINE_COMMENT;
+    } else if (allow_comment && (contains_char(lexer->multicomments1, c) || (lexer->singlecommentslen > 1 && contains_char(lexer->singlecomments, c)))) {
+        // Could open a comment, hold it until the next character arrives
+        lexer->pending[lexer->pending_len++] = c;
+    } else if (contains_char(lexer->strings, c)) {
+        flush_word(lexer, STREAM_PLAIN);
+        emit_span(lexer, &c, 1, 22);
+        lexer->state = STREAM_STRING;
+        lexer->string_delim = c;
+        lexer->string_escape = 0;
+    } else if (c == '(') {
+        flush_word(lexer, 28);
+        emit_span(lexer, &c, 1, 25);
+    } else if (c == '.') {
+        flush_word(lexer, -1);
+        emit_span(lexer, &c, 1, 25);
+        lexer->word_after_dot = 1;
+    } else if (isspace((unsigned char)c)) {
+        flush_word(lexer, -1);
+        emit_span(lexer, &c, 1, STREAM_PLAIN);
+    } else if (isdigit((unsigned char)c) && lexer->word_len == 0) {
+        emit_span(lexer, &c, 1, 27);
+    } else if (contains_char(lexer->operators, c)) {
+        flush_word(lexer, -1);
+        emit_span(lexer, &c, 1, 23);
+    } else if (contains_char(lexer->symbols, c)) {
+        flush_word(lexer, STREAM_PLAIN);
+        emit_span(lexer, &c, 1, 25);
+    } else {
+        push_word(lexer, c);
+    }
+}
+
+// Initialize a streaming lexer over the given syntax tables
+void stream_init(StreamLexer *lexer, HashTable *keywords, HashTable *singlecomments, HashTable *multicomments1, HashTable *multicomments2, HashTable *strings, HashTable *functions, HashTable *symbols, HashTable *operators, int singlecommentslen, span_callback emit, void *userdata) {
+    memset(lexer, 0, sizeof(*lexer));
+    lexer->keywords = keywords;
+    lexer->singlecomments = singlecomments;
+    lexer->multicomments1 = multicomments1;
+    lexer->multicomments2 = multicomments2;
+    lexer->strings = strings;
+    lexer->functions = functions;
+    lexer->symbols = symbols;
+    lexer->operators = operators;
+    lexer->emit = emit;
+    lexer->userdata = userdata;
+    lexer->state = STREAM_NORMAL;
+
+    // Comment prefixes are held in the fixed pending buffer
+    if (singlecommentslen > STREAM_PENDING_SIZE - 1) {
+        singlecommentslen = STREAM_PENDING_SIZE - 1;
+    }
+    lexer->singlecommentslen = singlecommentslen;
+}
+
+// Feed the next chunk of input, chunks may split any token
+void stream_feed(StreamLexer *lexer, const char *chunk, size_t len) {
+    size_t i = 0;
+
+    while (i < len) {
+        if (lexer->pending_len > 0 || lexer->state == STREAM_NORMAL) {
+            process_char(lexer, chunk[i], 1);
+            i++;
+            continue;
+        }
+
+        // Inside a string or comment: emit the whole run as one span
+        size_t start = i;
+        int color_pair = lexer->state == STREAM_STRING ? 22 : 21;
+        while (i < len && lexer->state != STREAM_NORMAL && step_inside(lexer, chunk[i])) {
+            i++;
+        }
+        emit_span(lexer, chunk + start, i - start, color_pair);
+    }
+
+    lexer->offset += len;
+}
+
+// Flush everything still held back at the end of the stream
+void stream_finish(StreamLexer *lexer) {
+    while (lexer->pending_len > 0) {
+        replay_pending(lexer, '\0', 0);
+    }
+    flush_word(lexer, -1);
+}
+
+// Capture the state at a line start, where no word or comment prefix is held back
+void stream_save_line_state(const StreamLexer *lexer, StreamLineState *line_state) {
+    line_state->state = lexer->state;
+    line_state->string_delim = lexer->string_delim;
+    line_state->string_escape = (char)lexer->string_escape;
+    line_state->block_close_pending = (char)lexer->block_close_pending;
+}
+
+// Resume lexing at a line start from a saved state
+void stream_restore_line_state(StreamLexer *lexer, const StreamLineState *line_state) {
+    lexer->state = line_state->state;
+    lexer->string_delim = line_state->string_delim;
+    lexer->string_escape = line_state->string_escape;
+    lexer->block_close_pending = line_state->block_close_pending;
+    lexer->pending_len = 0;
+    lexer->word_len = 0;
+    lexer->word_after_dot = 0;
+}
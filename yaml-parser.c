@@ -5,7 +5,20 @@
 #include <ctype.h>
 #include <ncurses.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "include/hashtable.h"
+#include "include/language.h"
+#include "include/detect.h"
+#include "include/stream.h"
+#include "include/lineindex.h"
+#include "include/latency.h"
+
+#define STREAM_CHUNK_SIZE 4096
+#define BUDGET_CHUNK_SIZE 1024
+#define PREVIEW_TIME_BUDGET_US 16000
+#define INDEX_CHUNK_SIZE (1 << 20)
 
 /*#define TABLE_SIZE 1000*/
 int multicomments1_length = 0;
@@ -405,20 +418,247 @@ void highlight_code(WINDOW *win, int start_y, int start_x, const char *code, Has
     }
 }
 
-int main() {
-    // Initialize hash tables
-    HashTable *keywords = create_table();
-    HashTable *singlecomments = create_table();
-    HashTable *multicomments1 = create_table();
-    HashTable *multicomments2 = create_table();
-    HashTable *strings = create_table();
-    HashTable *functions = create_table();
-    HashTable *symbols = create_table();
-    HashTable *operators = create_table();
-
-    // Load syntax elements from YAML file
-    int singlecommentslen = 0;
-    bool syntaxLoad = load_syntax("java.yaml", keywords, singlecomments, multicomments1, multicomments2, strings, functions, symbols, operators, &singlecommentslen);
+// Cursor position of spans drawn by the streaming lexer
+typedef struct {
+    WINDOW *win;
+    int start_x;
+    int x;
+    int y;
+    int last_row;   // bottom border row, never drawn on
+    int last_col;   // right border column, never drawn on
+    int scroll;     // scroll the interior up instead of dropping rows past last_row
+    int scrolled;   // interior was scrolled, the border needs redrawing
+} SpanCursor;
+
+// Set up a cursor that draws inside the border of a boxed window
+void span_cursor_init(SpanCursor *cur, WINDOW *win, int start_y, int start_x, int scroll) {
+    cur->win = win;
+    cur->start_x = start_x;
+    cur->x = start_x;
+    cur->y = start_y;
+    cur->last_row = getmaxy(win) - 1;
+    cur->last_col = getmaxx(win) - 1;
+    cur->scroll = scroll;
+    cur->scrolled = 0;
+}
+
+// Move to the next row, scrolling the interior if the cursor scrolls
+void span_newline(SpanCursor *cur) {
+    cur->x = cur->start_x;
+    cur->y++;
+    if (cur->scroll && cur->y >= cur->last_row) {
+        wscrl(cur->win, 1);
+        cur->y = cur->last_row - 1;
+        cur->scrolled = 1;
+    }
+}
+
+// Draw one span from the streaming lexer, moving to the next row on newlines
+void draw_span(const char *text, size_t len, int color_pair, void *userdata) {
+    SpanCursor *cur = (SpanCursor *)userdata;
+    const char *end = text + len;
+
+    while (text < end) {
+        const char *newline = memchr(text, '\n', end - text);
+        const char *stop = newline ? newline : end;
+
+        // Clip to the interior of the box
+        int width = cur->last_col - cur->x;
+        if (stop > text && cur->y < cur->last_row && width > 0) {
+            int n = stop - text < width ? (int)(stop - text) : width;
+            if (color_pair != STREAM_PLAIN) {
+                wattron(cur->win, COLOR_PAIR(color_pair));
+            }
+            mvwaddnstr(cur->win, cur->y, cur->x, text, n);
+            if (color_pair != STREAM_PLAIN) {
+                wattroff(cur->win, COLOR_PAIR(color_pair));
+            }
+        }
+        cur->x += stop - text;
+        if (newline) {
+            span_newline(cur);
+            stop++;
+        }
+        text = stop;
+    }
+}
+
+// Highlight input read from a file descriptor (e.g. a pipe) as it arrives
+void highlight_stream(WINDOW *win, int start_y, int start_x, int fd, HashTable *keywords, HashTable *singlecomments, HashTable *multicomments1, HashTable *multicomments2, HashTable *strings, HashTable *functions, HashTable *symbols, HashTable *operators, int *singlecommentslen) {
+    char chunk[STREAM_CHUNK_SIZE];
+    SpanCursor cursor;
+    StreamLexer lexer;
+    ssize_t nread;
+
+    // Only the interior rows scroll, so the newest lines stay visible
+    span_cursor_init(&cursor, win, start_y, start_x, 1);
+    scrollok(win, TRUE);
+    wsetscrreg(win, start_y, cursor.last_row - 1);
+
+    stream_init(&lexer, keywords, singlecomments, multicomments1, multicomments2, strings, functions, symbols, operators, *singlecommentslen, draw_span, &cursor);
+
+    while ((nread = read(fd, chunk, sizeof(chunk))) > 0) {
+        stream_feed(&lexer, chunk, (size_t)nread);
+        if (cursor.scrolled) {
+            box(win, 0, 0);
+            cursor.scrolled = 0;
+        }
+        wrefresh(win);
+    }
+
+    stream_finish(&lexer);
+    if (cursor.scrolled) {
+        box(win, 0, 0);
+    }
+    wrefresh(win);
+}
+
+// Highlight the visible part of a buffer within a time/byte budget, the rest is drawn plain.
+// The time budget counts from start_us, so work done before the call is charged to it too.
+void highlight_budget(WINDOW *win, int start_y, int start_x, const char *data, size_t len, const StreamLineState *line_state, const HighlightBudget *budget, long start_us, HighlightResult *result, HashTable *keywords, HashTable *singlecomments, HashTable *multicomments1, HashTable *multicomments2, HashTable *strings, HashTable *functions, HashTable *symbols, HashTable *operators, int *singlecommentslen) {
+    SpanCursor cursor;
+    StreamLexer lexer;
+    size_t offset = 0;
+
+    span_cursor_init(&cursor, win, start_y, start_x, 0);
+
+    stream_init(&lexer, keywords, singlecomments, multicomments1, multicomments2, strings, functions, symbols, operators, *singlecommentslen, draw_span, &cursor);
+    if (line_state != NULL) {
+        stream_restore_line_state(&lexer, line_state);
+    }
+
+    // Stop lexing once the window is full or the budget is used up. Input is fed one
+    // row at a time (capped at BUDGET_CHUNK_SIZE) so nothing is lexed past the last row.
+    while (offset < len && cursor.y < cursor.last_row && !budget_exhausted(budget, offset, start_us)) {
+        size_t chunk_len = len - offset < BUDGET_CHUNK_SIZE ? len - offset : BUDGET_CHUNK_SIZE;
+        if (budget != NULL && budget->bytes > 0 && chunk_len > budget->bytes - offset) {
+            chunk_len = budget->bytes - offset;
+        }
+        const char *newline = memchr(data + offset, '\n', chunk_len);
+        if (newline != NULL) {
+            chunk_len = newline + 1 - (data + offset);
+        }
+        stream_feed(&lexer, data + offset, chunk_len);
+        offset += chunk_len;
+    }
+    stream_finish(&lexer);
+
+    result->highlighted = offset;
+    result->completed = offset == len || cursor.y >= cursor.last_row;
+    result->approximate = 0;
+
+    // Out of budget: draw the remaining visible rows without colours
+    const char *tail = data + offset;
+    const char *end = data + len;
+    while (tail < end && cursor.y < cursor.last_row) {
+        const char *newline = memchr(tail, '\n', end - tail);
+        const char *row_end = newline ? newline + 1 : end;
+        draw_span(tail, row_end - tail, STREAM_PLAIN, &cursor);
+        tail = row_end;
+    }
+
+    wrefresh(win);
+    result->elapsed_us = latency_now_us() - start_us;
+}
+
+// Span callback for lexing that only needs the lexer state
+void skip_span(const char *text, size_t len, int color_pair, void *userdata) {
+    (void)text;
+    (void)len;
+    (void)color_pair;
+    (void)userdata;
+}
+
+// Highlight the visible part of a buffer starting at a given 0-based line, returns false if the line does not exist
+bool highlight_from_line(WINDOW *win, int start_y, int start_x, const char *data, size_t len, LineIndex *index, size_t line, const HighlightBudget *budget, long start_us, HighlightResult *result, HashTable *keywords, HashTable *singlecomments, HashTable *multicomments1, HashTable *multicomments2, HashTable *strings, HashTable *functions, HashTable *symbols, HashTable *operators, int *singlecommentslen) {
+    StreamLexer scanner;
+    StreamLineState line_state;
+    size_t offset;
+
+    // A trailing newline indexes an empty line at the end of the buffer, it is not a real line
+    if (!line_index_offset(index, line, &offset) || (len > 0 && offset == len)) {
+        return false;
+    }
+
+    // Recover whether the line starts inside a string or comment
+    stream_init(&scanner, keywords, singlecomments, multicomments1, multicomments2, strings, functions, symbols, operators, *singlecommentslen, skip_span, NULL);
+    LineStateResult state = line_index_state(index, data, line, &scanner, budget, start_us, &line_state);
+
+    // Jump straight to the line instead of scanning from the start of the buffer
+    highlight_budget(win, start_y, start_x, data + offset, len - offset, &line_state, budget, start_us, result, keywords, singlecomments, multicomments1, multicomments2, strings, functions, symbols, operators, singlecommentslen);
+    result->approximate = state == LINE_STATE_APPROXIMATE;
+    return true;
+}
+
+// Outcome of previewing a file
+typedef enum {
+    PREVIEW_OK,
+    PREVIEW_OPEN_FAILED,
+    PREVIEW_LINE_OUT_OF_RANGE
+} PreviewStatus;
+
+// Map a file and highlight it from a 1-based line number. The budget and result->elapsed_us
+// cover the whole preview: opening, mapping and indexing the file as well as drawing it.
+// The caller keeps one index per file and language across previews; it is only extended as
+// far as the requested line, so later previews reuse its offsets and cached lexer states.
+PreviewStatus highlight_file(WINDOW *win, int start_y, int start_x, const char *path, size_t line, LineIndex *index, const HighlightBudget *budget, HighlightResult *result, HashTable *keywords, HashTable *singlecomments, HashTable *multicomments1, HashTable *multicomments2, HashTable *strings, HashTable *functions, HashTable *symbols, HashTable *operators, int *singlecommentslen) {
+    long start_us = latency_now_us();
+    struct stat st;
+
+    memset(result, 0, sizeof(HighlightResult));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        result->elapsed_us = latency_now_us() - start_us;
+        return PREVIEW_OPEN_FAILED;
+    }
+
+    size_t len = (size_t)st.st_size;
+    char *data = len > 0 ? mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0) : NULL;
+    close(fd);
+    if (data == MAP_FAILED) {
+        result->elapsed_us = latency_now_us() - start_us;
+        return PREVIEW_OPEN_FAILED;
+    }
+
+    // A file that shrank was rewritten, the old offsets are useless
+    if (len < index->length) {
+        line_index_reset(index);
+    }
+    while (index->line_count < line && index->length < len) {
+        size_t chunk_len = len - index->length < INDEX_CHUNK_SIZE ? len - index->length : INDEX_CHUNK_SIZE;
+        line_index_append(index, data + index->length, chunk_len);
+    }
+    bool found = line > 0 && highlight_from_line(win, start_y, start_x, data, len, index, line - 1, budget, start_us, result, keywords, singlecomments, multicomments1, multicomments2, strings, functions, symbols, operators, singlecommentslen);
+
+    if (data != NULL) {
+        munmap(data, len);
+    }
+    result->elapsed_us = latency_now_us() - start_us;
+    return found ? PREVIEW_OK : PREVIEW_LINE_OUT_OF_RANGE;
+}
+
+int main(int argc, char *argv[]) {
+    // Load every configured syntax file in parallel
+    const char *syntax_files[] = { "c.yaml", "java.yaml", "python.yaml" };
+    int language_count = sizeof(syntax_files) / sizeof(syntax_files[0]);
+    Language *languages = load_languages(syntax_files, language_count, LOAD_THREADS);
+
+    // Java is the default language unless the previewed file looks like another one
+    Language *lang = language_by_name(languages, language_count, "java");
+    if (lang == NULL) {
+        lang = &languages[0];
+    }
+    double confidence = 0.0;
+    if (argc > 1) {
+        int detected = detect_file_language(argv[1], languages, language_count, DETECT_TIME_BUDGET_US, &confidence);
+        if (detected >= 0 && confidence >= DETECT_MIN_CONFIDENCE) {
+            lang = &languages[detected];
+        }
+    }
+    bool syntaxLoad = lang->loaded;
 
     // Initialize ncurses
     initscr();
@@ -457,9 +697,39 @@ int main() {
     "}";
 
 
+    // Previews favour latency over complete colouring
+    HighlightBudget budget = { PREVIEW_TIME_BUDGET_US, 0 };
+    HighlightResult result;
+    LatencyHistogram preview_latency;
+    latency_init(&preview_latency);
+
     // Highlight the code
-    if (syntaxLoad) {
-      highlight_code(win, 1, 1, java_code, keywords, singlecomments, multicomments1, multicomments2, strings, functions, symbols, operators, &singlecommentslen);
+    if (syntaxLoad && argc > 1) {
+      // Preview a file, optionally starting at the line given as the second argument
+      char *line_end = NULL;
+      long line = argc > 2 ? strtol(argv[2], &line_end, 10) : 1;
+      PreviewStatus status = PREVIEW_LINE_OUT_OF_RANGE;
+      LineIndex *index = line_index_create();
+      memset(&result, 0, sizeof(result));
+      if (line >= 1 && (line_end == NULL || (line_end != argv[2] && *line_end == '\0'))) {
+        status = highlight_file(win, 1, 1, argv[1], (size_t)line, index, &budget, &result, lang->keywords, lang->singlecomments, lang->multicomments1, lang->multicomments2, lang->strings, lang->functions, lang->symbols, lang->operators, &lang->singlecommentslen);
+      }
+      line_index_free(index);
+
+      // Failed previews cost time too, so every attempt is recorded
+      latency_record(&preview_latency, result.elapsed_us);
+      if (status == PREVIEW_OPEN_FAILED) {
+        mvwprintw(win, 3, 1, "COULD NOT OPEN FILE: %s", argv[1]);
+        wrefresh(win);
+      } else {
+        mvwprintw(win, 3, 1, "LINE OUT OF RANGE: %s", argv[2]);
+        wrefresh(win);
+      }
+    } else if (syntaxLoad && !isatty(STDIN_FILENO)) {
+      // Piped input is highlighted incrementally instead of the sample
+      highlight_stream(win, 1, 1, STDIN_FILENO, lang->keywords, lang->singlecomments, lang->multicomments1, lang->multicomments2, lang->strings, lang->functions, lang->symbols, lang->operators, &lang->singlecommentslen);
+    } else if (syntaxLoad) {
+      highlight_code(win, 1, 1, java_code, lang->keywords, lang->singlecomments, lang->multicomments1, lang->multicomments2, lang->strings, lang->functions, lang->symbols, lang->operators, &lang->singlecommentslen);
       wrefresh(win);
     } else {
       mvwprintw(win, 3, 1, "NO YAML FILE FOUND!");
@@ -472,12 +742,18 @@ int main() {
     delwin(win);
     endwin();
     //printf("%d %d", multicomments1_length, multicomments2_length);
-    free_table(keywords);
-    free_table(singlecomments);
-    free_table(strings);
-    free_table(functions);
-    free_table(symbols);
-    free_table(operators);
+    if (preview_latency.total > 0) {
+        fprintf(stderr, " [PREVIEW] p50 %ldus p99 %ldus, highlighted %zu bytes%s%s\n", latency_percentile(&preview_latency, 50), latency_percentile(&preview_latency, 99), result.highlighted, result.completed ? "" : " (budget exhausted)", result.approximate ? " (start state approximate)" : "");
+    }
+    for (int i = 0; i < language_count; ++i) {
+        fprintf(stderr, " [LOAD] %s %s in %ldus\n", languages[i].path, languages[i].loaded ? "loaded" : "failed", languages[i].load_us);
+    }
+    fprintf(stderr, " [INTERN] %zu distinct keys shared by %d languages\n", intern_count(), language_count);
+    if (argc > 1) {
+        fprintf(stderr, " [DETECT] %s highlighted as %s (confidence %.2f)\n", argv[1], lang->name, confidence);
+    }
+    free_languages(languages, language_count);
+    intern_pool_free();
 
     return 0;
 }